@@ -0,0 +1,162 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+/*
+ * An ROI rasterised once into horizontal spans relative to its bounding box.
+ * Cropping then copies only the covered pixels of the bounding box, instead
+ * of building a full-frame mask and running bitwise_and over the whole image
+ * every frame as crop_circle/crop_polygon do. Moving the ROI by a whole
+ * number of pixels only moves the bounding box; the spans stay valid.
+ */
+
+struct RoiSpan
+{
+    int y;      // row inside bbox
+    int x0;     // first column inside bbox
+    int x1;     // one past the last column
+};
+
+struct CompiledRoi
+{
+    Rect bbox;
+    vector<RoiSpan> spans;
+    bool full;  // axis-aligned rectangle: the crop is a plain view
+};
+
+/*********************************************************************/
+inline CompiledRoi compile_mask(const Mat& mask, const Rect& bbox)
+{
+    CompiledRoi roi;
+    roi.bbox = bbox;
+    roi.full = false;
+
+    for (int y = 0; y < mask.rows; y++)
+    {
+        const uchar* row = mask.ptr<uchar>(y);
+        int x = 0;
+        while (x < mask.cols)
+        {
+            while (x < mask.cols && row[x] == 0)
+            {
+                x++;
+            }
+            const int start = x;
+            while (x < mask.cols && row[x] != 0)
+            {
+                x++;
+            }
+            if (x > start)
+            {
+                roi.spans.push_back({y, start, x});
+            }
+        }
+    }
+
+    return roi;
+}
+/*********************************************************************/
+inline CompiledRoi compile_rect(int tl_x, int tl_y, int br_x, int br_y)
+{
+    CompiledRoi roi;
+    roi.bbox = Rect(Point(tl_x, tl_y), Point(br_x, br_y));
+    roi.full = true;
+    for (int y = 0; y < roi.bbox.height; y++)
+    {
+        roi.spans.push_back({y, 0, roi.bbox.width});
+    }
+    return roi;
+}
+/*********************************************************************/
+inline CompiledRoi compile_circle(Point center, int radius)
+{
+    // same extent crop_circle uses, rasterised with the same primitive
+    const Rect bbox(center.x - radius, center.y - radius, 2 * radius, 2 * radius);
+    Mat mask(bbox.size(), CV_8UC1, Scalar(0));
+    circle(mask, center - bbox.tl(), radius, Scalar(255), -1);
+    return compile_mask(mask, bbox);
+}
+/*********************************************************************/
+inline CompiledRoi compile_polygon(const vector<Point>& vertices)
+{
+    const Rect bbox = boundingRect(vertices);
+
+    vector<Point> local;
+    for (const Point& p : vertices)
+    {
+        local.push_back(p - bbox.tl());
+    }
+
+    Mat mask(bbox.size(), CV_8UC1, Scalar(0));
+    fillConvexPoly(mask, local, Scalar(255));
+
+    CompiledRoi roi = compile_mask(mask, bbox);
+    roi.full = vertices.size() == 4 && roi.spans.size() == (size_t)bbox.height;
+    for (const RoiSpan& s : roi.spans)
+    {
+        roi.full = roi.full && s.x0 == 0 && s.x1 == bbox.width;
+    }
+    return roi;
+}
+/*********************************************************************/
+inline void translate_compiled(CompiledRoi& roi, Point offset)
+{
+    roi.bbox += offset;
+}
+/*********************************************************************/
+// Pixels of the ROI that fall outside img are left black.
+inline Mat crop_compiled(const Mat& img, const CompiledRoi& roi)
+{
+    const Rect frame_rect(0, 0, img.cols, img.rows);
+    const Rect visible = roi.bbox & frame_rect;
+
+    if (roi.full && visible == roi.bbox)
+    {
+        return img(roi.bbox);
+    }
+
+    Mat out(roi.bbox.size(), img.type(), Scalar::all(0));
+    if (visible.empty())
+    {
+        return out;
+    }
+
+    const size_t elem = img.elemSize();
+    for (const RoiSpan& s : roi.spans)
+    {
+        const int y = roi.bbox.y + s.y;
+        if (y < visible.y || y >= visible.y + visible.height)
+        {
+            continue;
+        }
+
+        const int x0 = max(roi.bbox.x + s.x0, visible.x);
+        const int x1 = min(roi.bbox.x + s.x1, visible.x + visible.width);
+        if (x1 <= x0)
+        {
+            continue;
+        }
+
+        memcpy(out.ptr(s.y) + (x0 - roi.bbox.x) * elem, img.ptr(y) + x0 * elem, (x1 - x0) * elem);
+    }
+
+    return out;
+}
+/*********************************************************************/
+inline unordered_map<int, Mat> crop_compiled(const Mat& img, const unordered_map<int, CompiledRoi>& rois)
+{
+    unordered_map<int, Mat> cropped_images;
+    for (const auto& roi : rois)
+    {
+        cropped_images[roi.first] = crop_compiled(img, roi.second);
+    }
+    return cropped_images;
+}
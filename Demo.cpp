@@ -2,7 +2,6 @@
 #include <opencv2/videoio.hpp>
 #include <iostream>
 #include <vector>
-#include <map>
 #include "EasyRoi.hpp"
 
 using namespace cv;
@@ -25,17 +24,17 @@ int main()
     EasyROI roi_helper(true);
 
     // DRAW RECTANGULAR ROI
-    vector<vector<Point>> rect_roi = roi_helper.draw_rectangle(frame, 3);
+    RoiBuilder rect_roi = roi_helper.draw_rectangle(frame, 3);
     cout << "Rectangle Example:" << endl;
-    for (const auto& rect : rect_roi) 
+    for (const auto& rect : rect_roi.rectangles()) 
     {
-        cout << rect << endl;
+        cout << rect.first << ": " << Mat(rect.second).t() << endl;
     }
 
     Mat frame_temp = roi_helper.visualize_roi(frame, rect_roi);
 
     // crop drawn rectangles
-    map<int, Mat> cropped_rects = roi_helper.crop_roi(frame, rect_roi);
+    unordered_map<int, Mat> cropped_rects = roi_helper.crop_roi(frame, rect_roi);
     for (const auto& crop : cropped_rects) 
     {
         imshow(to_string(crop.first), crop.second);
@@ -46,11 +45,11 @@ int main()
     destroyAllWindows();
 
     // DRAW LINE ROI
-    vector<vector<Point>> line_roi = roi_helper.draw_line(frame, 3);
+    RoiBuilder line_roi = roi_helper.draw_line(frame, 3);
     cout << "Line Example:" << endl;
-    for (const auto& line : line_roi) 
+    for (const auto& line : line_roi.lines()) 
     {
-        cout << line << endl;
+        cout << line.first << ": " << Mat(line.second).t() << endl;
     }
 
     frame_temp = roi_helper.visualize_roi(frame, line_roi);
@@ -59,17 +58,17 @@ int main()
     destroyAllWindows();
 
     // DRAW CIRCLE ROI
-    vector<vector<Point>> circle_roi = roi_helper.draw_circle(frame, 3);
+    RoiBuilder circle_roi = roi_helper.draw_circle(frame, 3);
     cout << "Circle Example:" << endl;
-    for (const auto& circle : circle_roi) 
+    for (const auto& circle : circle_roi.circles()) 
     {
-        cout << circle << endl;
+        cout << circle.first << ": " << Mat(circle.second).t() << endl;
     }
 
     frame_temp = roi_helper.visualize_roi(frame, circle_roi);
 
     // crop drawn circles
-    map<int, Mat> cropped_circles = roi_helper.crop_roi(frame, circle_roi);
+    unordered_map<int, Mat> cropped_circles = roi_helper.crop_roi(frame, circle_roi);
     for (const auto& crop : cropped_circles) 
     {
         imshow(to_string(crop.first), crop.second);
@@ -80,17 +79,17 @@ int main()
     destroyAllWindows();
 
     // DRAW POLYGON ROI
-    vector<vector<Point>> polygon_roi = roi_helper.draw_polygon(frame, 3);
+    RoiBuilder polygon_roi = roi_helper.draw_polygon(frame, 3);
     cout << "Polygon Example:" << endl;
-    for (const auto& poly : polygon_roi) 
+    for (const auto& poly : polygon_roi.polygons()) 
     {
-        cout << poly << endl;
+        cout << poly.first << ": " << Mat(poly.second).t() << endl;
     }
 
     frame_temp = roi_helper.visualize_roi(frame, polygon_roi);
 
     // crop drawn polygons
-    map<int, Mat> cropped_polys = roi_helper.crop_roi(frame, polygon_roi);
+    unordered_map<int, Mat> cropped_polys = roi_helper.crop_roi(frame, polygon_roi);
     for (const auto& crop : cropped_polys) 
     {
         imshow(to_string(crop.first), crop.second);
@@ -1,6 +1,10 @@
-#include <opencv2/opencv.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/highgui.hpp>
 #include <iostream>
+#include <string>
 #include <vector>
+#include "RoiCore.hpp"
 
 using namespace cv;
 using namespace std;
@@ -22,20 +26,29 @@ class EasyROI
       vector<bool> line_drawn;
       vector<bool> circle_drawn;
       vector<bool> polygon_drawn;
-      map<int, map<string, int>> roi_dict;
+      RoiBuilder roi_builder;
+      int roi_count;
+      bool windows_opened;
 
   public:
       /*********************************************************************/
       EasyROI(bool verbose=false) 
       {
           this->verbose = verbose;
+          windows_opened = false;
           init_variables();
       }
       /*********************************************************************/
       void init_variables() 
       {
-          destroyAllWindows();
-          roi_dict.clear();
+          // only touch HighGUI once a draw_* call has opened a window
+          if (windows_opened)
+          {
+              destroyAllWindows();
+              windows_opened = false;
+          }
+          roi_builder.clear();
+          roi_count = 0;
           drawing = false;
           img.release();
           quantity = 0;
@@ -52,7 +65,7 @@ class EasyROI
           polygon_drawn.clear();
       }
       /*********************************************************************/
-      map<int, map<string, int>> draw_line(Mat frame, int quantity=1) 
+      RoiBuilder draw_line(Mat frame, int quantity=1) 
       {
           if (verbose) 
           {
@@ -64,19 +77,17 @@ class EasyROI
   
           img = frame.clone();
           this->quantity = quantity;
+          windows_opened = true;
   
           string window_name = "Draw " + to_string(this->quantity) + " Line(s)";
           namedWindow(window_name);
-          setMouseCallback(window_name, draw_line_callback);
+          setMouseCallback(window_name, draw_line_callback, this);
   
           last_orig_frame = img.clone();
           orig_frame = img.clone();
   
           line_drawn = vector<bool>(this->quantity, false);
   
-          roi_dict["type"] = "line";
-          roi_dict["roi"] = map<string, int>();
-
           while (true) 
           {
               imshow(window_name, img);
@@ -89,20 +100,20 @@ class EasyROI
               }
           }
 
-          if (verbose && roi_dict["roi"].size() != this->quantity) 
+          if (verbose && roi_count != this->quantity) 
           {
               cout << "[DEBUG] Not all ROI's drawn" << endl;
-              roi_dict.clear();
+              roi_builder.clear();
           }
   
-          map<int, map<string, int>> roi_dict_temp = roi_dict;
+          RoiBuilder roi_builder_temp = roi_builder;
   
           init_variables();
   
-          return roi_dict_temp;
+          return roi_builder_temp;
       }
       /*********************************************************************/
-      map<int, map<string, int>> draw_rectangle(Mat frame, int quantity=1) 
+      RoiBuilder draw_rectangle(Mat frame, int quantity=1) 
       {
           if (verbose) 
           {
@@ -111,9 +122,7 @@ class EasyROI
   
           img = frame.clone();
           this->quantity = quantity;
-  
-          roi_dict["type"] = "rectangle";
-          roi_dict["roi"] = map<string, int>();
+          windows_opened = true;
   
           for (int i = 0; i < this->quantity; i++) 
           {
@@ -127,28 +136,21 @@ class EasyROI
   
               if (verbose && (w == 0 || h == 0)) {
                   cout << "[DEBUG] Not all ROI's drawn" << endl;
-                  return map<int, map<string, int>>();
+                  return RoiBuilder();
               }
   
               rectangle(img, Point(tl_x, tl_y), Point(br_x, br_y), brush_color_finished, 2);
   
-              roi_dict["roi"][i] = 
-              {
-                  {"tl_x", tl_x},
-                  {"tl_y", tl_y},
-                  {"br_x", br_x},
-                  {"br_y", br_y},
-                  {"w", w},
-                  {"h", h}
-              };
+              roi_builder.add_rectangle(i, tl_x, tl_y, br_x, br_y);
+              roi_count++;
           }
   
-          map<int, map<string, int>> roi_dict_temp = roi_dict;  
+          RoiBuilder roi_builder_temp = roi_builder;  
           init_variables();  
-          return roi_dict_temp;
+          return roi_builder_temp;
       }
       /*********************************************************************/
-      map<int, map<string, int>> draw_polygon(Mat frame, int quantity=1) 
+      RoiBuilder draw_polygon(Mat frame, int quantity=1) 
       {
           if (verbose) 
           {
@@ -161,19 +163,17 @@ class EasyROI
   
           img = frame.clone();
           this->quantity = quantity;
+          windows_opened = true;
   
           string window_name = "Draw " + to_string(this->quantity) + " Polygon(s)";
           namedWindow(window_name);
-          setMouseCallback(window_name, draw_polygon_callback);
+          setMouseCallback(window_name, draw_polygon_callback, this);
   
           last_orig_frame = img.clone();
           orig_frame = img.clone();
   
           polygon_drawn = vector<bool>(this->quantity, false);
   
-          roi_dict["type"] = "polygon";
-          roi_dict["roi"] = map<string, int>();
-  
           while (true) 
           {
               imshow(window_name, img);
@@ -186,20 +186,20 @@ class EasyROI
               }
           }
   
-          if (verbose && roi_dict["roi"].size() != this->quantity) 
+          if (verbose && roi_count != this->quantity) 
           {
               cout << "[DEBUG] Not all ROI's drawn" << endl;
-              roi_dict.clear();
+              roi_builder.clear();
           }
   
-          map<int, map<string, int>> roi_dict_temp = roi_dict;
+          RoiBuilder roi_builder_temp = roi_builder;
   
           init_variables();
   
-          return roi_dict_temp;
+          return roi_builder_temp;
       }
       /*********************************************************************/
-      map<int, map<string, int>> draw_cuboid(Mat frame, int quantity=1) 
+      RoiBuilder draw_cuboid(Mat frame, int quantity=1) 
       {
           // TODO: Implement draw_cuboid
            if (verbose) 
@@ -209,17 +209,19 @@ class EasyROI
   
           img = frame.clone();
           this->quantity = quantity;
+          windows_opened = true;
   
-          roi_dict["type"] = "cuboid";
-          roi_dict["roi"] = map<string, int>();
-
           for (int i = 0; i < this->quantity; i++) 
           {
               Rect roi_ = selectROI("Draw " + to_string(this->quantity) + " Cuboid(s)", img, false, false);          
           }
+
+          // the core has no cuboid shape yet, so nothing is returned
+          init_variables();
+          return RoiBuilder();
       }
       /*********************************************************************/
-      map<int, map<string, int>> draw_circle(Mat frame, int quantity=1) 
+      RoiBuilder draw_circle(Mat frame, int quantity=1) 
       {
           if (verbose) 
           {
@@ -231,19 +233,17 @@ class EasyROI
   
           img = frame.clone();
           this->quantity = quantity;
+          windows_opened = true;
   
           string window_name = "Draw " + to_string(this->quantity) + " Circle(s)";
           namedWindow(window_name);
-          setMouseCallback(window_name, draw_circle_callback);
+          setMouseCallback(window_name, draw_circle_callback, this);
   
           last_orig_frame = img.clone();
           orig_frame = img.clone();
   
           circle_drawn = vector<bool>(this->quantity, false);
   
-          roi_dict["type"] = "circle";
-          roi_dict["roi"] = map<string, int>();
-  
           while (true) 
           {
               imshow(window_name, img);
@@ -257,17 +257,17 @@ class EasyROI
               }
           }
   
-          if (verbose && roi_dict["roi"].size() != this->quantity) 
+          if (verbose && roi_count != this->quantity) 
           {
               cout << "[DEBUG] Not all ROI's drawn" << endl;
-              roi_dict.clear();
+              roi_builder.clear();
           }
   
-          map<int, map<string, int>> roi_dict_temp = roi_dict;
+          RoiBuilder roi_builder_temp = roi_builder;
   
           init_variables();
   
-          return roi_dict_temp;
+          return roi_builder_temp;
       }
       /********************************************************************************/
       static void draw_line_callback(int event, int x, int y, int flags, void* param) 
@@ -300,11 +300,8 @@ class EasyROI
               }
   
               line(self->img, Point(self->cursor_x, self->cursor_y), Point(x, y), self->brush_color_finished, 2);  
-              self->roi_dict["roi"][line_index] =
-              {
-                  {"point1", Point(self->cursor_x, self->cursor_y)},
-                  {"point2", Point(x, y)}
-              };
+              self->roi_builder.add_line(line_index, Point(self->cursor_x, self->cursor_y), Point(x, y));
+              self->roi_count++;
   
               self->orig_frame = self->img.clone();  
               self->line_drawn[line_index] = true;
@@ -352,12 +349,8 @@ class EasyROI
               line(self->img, Point(self->cursor_x, self->cursor_y), Point(x, y), self->brush_color_finished, 2);
               circle(self->img, center, radius, self->brush_color_finished, 2);
   
-              self->roi_dict["roi"][circle_index] = 
-              {
-                  {"center", Point(self->cursor_x, self->cursor_y)},
-                  {"point2", Point(x, y)},
-                  {"radius", radius}
-              };
+              self->roi_builder.add_circle(circle_index, center, radius);
+              self->roi_count++;
   
               self->orig_frame = self->img.clone();
   
@@ -431,10 +424,8 @@ class EasyROI
                   }
               }
   
-              self->roi_dict["roi"][polygon_index] = 
-              {
-                  {"vertices", self->polygon_vertices}
-              };
+              self->roi_builder.add_polygon(polygon_index, self->polygon_vertices);
+              self->roi_count++;
   
               self->orig_frame = self->img.clone();
               self->last_orig_frame = self->orig_frame.clone();
@@ -447,7 +438,10 @@ class EasyROI
       /*********************************************************************/
       ~EasyROI() 
       {
-          destroyAllWindows();
+          if (windows_opened)
+          {
+              destroyAllWindows();
+          }
   
           if (verbose) 
           {
@@ -455,79 +449,21 @@ class EasyROI
           }
       }
       /*********************************************************************/
-      Mat visualize_roi(Mat frame, map<int, map<string, int>> roi_dict) 
+      // Drawing and cropping go through the same GUI-free core that headless
+      // workers use, so crops from the editor come from the compiled spans.
+      Mat visualize_roi(Mat frame, const RoiBuilder& roi) 
       {
-          if (roi_dict.find("roi") == roi_dict.end()) 
-          {
-              return frame;
-          }
-  
-          Mat img = frame.clone();
-  
-          if (roi_dict["type"] == "rectangle") 
-          {
-              visualize_rect(img, roi_dict);
-          }
-          else 
-          if (roi_dict["type"] == "line") 
-          {
-              visualize_line(img, roi_dict);
-          }
-          else 
-          if (roi_dict["type"] == "circle") 
-          {
-              visualize_circle(img, roi_dict);
-          }
-          else 
-          if (roi_dict["type"] == "polygon") 
-          {
-              visualize_polygon(img, roi_dict);
-          }
-          else 
-          if (roi_dict["type"] == "cuboid") 
-          {
-              visualize_cuboid(img, roi_dict);
-          }
-  
-          return img;
+          return roi.visualize(frame);
       }
       /*********************************************************************/
-      vector<Mat> crop_roi(Mat frame, map<int, map<string, int>> roi_dict) 
+      unordered_map<int, Mat> crop_roi(Mat frame, const RoiBuilder& roi) 
       {
-          if (roi_dict.find("roi") == roi_dict.end()) 
-          {
-              return vector<Mat>();
-          }
-  
-          Mat img = frame.clone();
-          vector<Mat> cropped_images;
-  
-          if (roi_dict["type"] == "rectangle") 
-          {
-            cropped_images = crop_rect(img, roi_dict);
-          }
-          else 
-          if (roi_dict["type"] == "line") 
+          if (roi.compiled_rois().empty() && !roi.lines().empty()) 
           {
               cout << "[ERROR] What to crop in line roi:)" << endl;
           }
-          else 
-          if (roi_dict["type"] == "circle") 
-          {
-              cropped_images = crop_circle(img, roi_dict);
-          }
-          else 
-          if (roi_dict["type"] == "polygon") 
-          {
-              cropped_images = crop_polygon(img, roi_dict);
-          }
-          else 
-          if (roi_dict["type"] == "cuboid")
-          {
-              cropped_images = crop_cuboid(img, roi_dict);
-          }
   
-          return cropped_images;
+          return roi.crop(frame);
       }
 };
 
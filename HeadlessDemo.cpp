@@ -0,0 +1,58 @@
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "RoiCore.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Builds ROIs in code and crops every frame of overpass.mp4 without HighGUI.
+// Only opencv_core, opencv_imgproc, opencv_videoio and opencv_imgcodecs are
+// needed; the result is written to roi_preview.png instead of shown.
+
+int main()
+{
+    string video_path = "overpass.mp4";
+
+    VideoCapture cap(video_path);
+    if (!cap.isOpened())
+    {
+        cerr << "Cannot capture source" << endl;
+        return -1;
+    }
+
+    Mat frame;
+    cap >> frame;
+    const int w = frame.cols;
+    const int h = frame.rows;
+
+    RoiBuilder rois;
+    rois.add_rectangle(0, 0, h / 2, w / 3, h)
+        .add_polygon(1, {Point(w / 3 + w / 12, h / 3), Point(2 * w / 3 - w / 12, h / 3),
+                         Point(2 * w / 3, h - 1), Point(w / 3, h - 1)})
+        .add_circle(2, Point(5 * w / 6, 2 * h / 3), h / 6)
+        .add_line(3, Point(0, h / 2), Point(w - 1, h / 2));
+
+    imwrite("roi_preview.png", rois.visualize(frame));
+
+    double crop_ms = 0;
+    int frames = 0;
+    while (cap.read(frame))
+    {
+        const auto start = chrono::steady_clock::now();
+        unordered_map<int, Mat> crops = rois.crop(frame);
+        crop_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        frames++;
+    }
+
+    if (frames > 0)
+    {
+        cout << "Cropped " << rois.compiled_rois().size() << " ROI(s) from " << frames << " frame(s), "
+             << crop_ms / frames << " ms/frame" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <opencv2/opencv.hpp>
+#include <opencv2/videoio.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Utils.hpp"
+#include "LiveMode.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Plays overpass.mp4 at its native frame rate as a stand-in live source and
+// crops a few polygon ROIs from every frame that survives the drop policy.
+// Usage: LiveDemo [drop_oldest|drop_newest|process_latest] [capacity] [workers]
+
+int main(int argc, char** argv)
+{
+    string video_path = "overpass.mp4";
+
+    LiveDropPolicy policy = PROCESS_LATEST;
+    string policy_name = argc > 1 ? argv[1] : "process_latest";
+    if (policy_name == "drop_oldest")
+    {
+        policy = DROP_OLDEST;
+    }
+    else
+    if (policy_name == "drop_newest")
+    {
+        policy = DROP_NEWEST;
+    }
+    else
+    if (policy_name != "process_latest")
+    {
+        cerr << "Usage: " << argv[0] << " [drop_oldest|drop_newest|process_latest] [capacity] [workers]" << endl;
+        return -1;
+    }
+    const int capacity = argc > 2 ? stoi(argv[2]) : 1;
+    const int workers = argc > 3 ? stoi(argv[3]) : 1;
+
+    VideoCapture cap(video_path);
+    if (!cap.isOpened())
+    {
+        cerr << "Cannot capture source" << endl;
+        return -1;
+    }
+
+    const int w = (int)cap.get(CAP_PROP_FRAME_WIDTH);
+    const int h = (int)cap.get(CAP_PROP_FRAME_HEIGHT);
+    unordered_map<int, vector<Point>> polygon_roi;
+    for (int i = 0; i < 3; i++)
+    {
+        const int x0 = i * w / 3;
+        const int x1 = (i + 1) * w / 3 - 1;
+        polygon_roi[i] = {Point(x0 + w / 12, h / 3), Point(x1 - w / 12, h / 3), Point(x1, h - 1), Point(x0, h - 1)};
+    }
+
+    LiveRoiLoop loop(policy, capacity, workers, true);
+    LiveStats stats = loop.run(cap, [&](const LiveFrame& f)
+    {
+        unordered_map<int, Mat> crops = crop_polygon(f.frame, polygon_roi);
+    });
+
+    cout << policy_name << ": " << stats.processed << "/" << stats.captured << " frame(s) processed, "
+         << stats.dropped << " dropped" << endl;
+    cout << "Capture-to-output latency mean " << stats.mean_latency_ms << " ms, p95 "
+         << stats.p95_latency_ms << " ms, max " << stats.max_latency_ms << " ms" << endl;
+
+    return 0;
+}
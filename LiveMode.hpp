@@ -0,0 +1,413 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+/*
+ * Real-time mode for live sources. The thread calling run() captures and
+ * pushes frames into a small lock-free ring, ROI worker threads pop from it
+ * and are woken by each push instead of polling; when the workers fall
+ * behind, the drop policy decides which frames are discarded instead of
+ * letting lag build up.
+ *
+ *   DROP_OLDEST    - ring full: evict the oldest queued frame
+ *   DROP_NEWEST    - ring full: discard the frame just captured
+ *   PROCESS_LATEST - workers always skip to the newest queued frame
+ */
+enum LiveDropPolicy
+{
+    DROP_OLDEST,
+    DROP_NEWEST,
+    PROCESS_LATEST
+};
+
+struct LiveFrame
+{
+    Mat frame;
+    int64_t seq;
+    chrono::steady_clock::time_point captured;
+};
+
+struct LiveStats
+{
+    int64_t captured;
+    int64_t processed;
+    int64_t dropped;
+    double mean_latency_ms;
+    double p50_latency_ms;
+    double p95_latency_ms;
+    double max_latency_ms;
+};
+
+/*
+ * Single producer, multiple consumers. head/tail are free-running sequence
+ * numbers; whoever wins the CAS on tail owns the frames it skipped over, so
+ * the producer evicting for DROP_OLDEST and workers popping use the same
+ * claim protocol.
+ */
+class LiveFrameRing
+{
+  private:
+      LiveDropPolicy policy;
+      uint64_t capacity;
+      unique_ptr<atomic<LiveFrame*>[]> slots;
+      atomic<uint64_t> head;
+      atomic<uint64_t> tail;
+      atomic<int64_t> dropped;
+
+      /*********************************************************************/
+      // Only called by the owner of a claimed sequence number; the producer
+      // published the slot before moving head past it.
+      LiveFrame* take(uint64_t seq)
+      {
+          return slots[seq % capacity].exchange(nullptr, memory_order_acq_rel);
+      }
+
+  public:
+      /*********************************************************************/
+      LiveFrameRing(LiveDropPolicy policy=PROCESS_LATEST, int capacity=1)
+          : slots(new atomic<LiveFrame*>[max(capacity, 1)]), head(0), tail(0), dropped(0)
+      {
+          this->policy = policy;
+          this->capacity = max(capacity, 1);
+          for (uint64_t i = 0; i < this->capacity; i++)
+          {
+              slots[i].store(nullptr, memory_order_relaxed);
+          }
+      }
+      /*********************************************************************/
+      ~LiveFrameRing()
+      {
+          for (uint64_t i = 0; i < capacity; i++)
+          {
+              delete slots[i].exchange(nullptr);
+          }
+      }
+      /*********************************************************************/
+      // Producer only. Takes ownership of frame. Returns false if the frame
+      // itself was dropped.
+      bool push(LiveFrame* frame)
+      {
+          const uint64_t h = head.load(memory_order_relaxed);
+          uint64_t t = tail.load(memory_order_acquire);
+          while (h - t >= capacity)
+          {
+              if (policy == DROP_NEWEST)
+              {
+                  delete frame;
+                  dropped.fetch_add(1, memory_order_relaxed);
+                  return false;
+              }
+
+              if (tail.compare_exchange_weak(t, t + 1, memory_order_acq_rel))
+              {
+                  delete take(t);
+                  dropped.fetch_add(1, memory_order_relaxed);
+                  t++;
+              }
+          }
+
+          // A worker may have claimed the previous occupant but not yet taken
+          // it out; that window is a handful of instructions.
+          LiveFrame* expected = nullptr;
+          while (!slots[h % capacity].compare_exchange_weak(expected, frame, memory_order_acq_rel))
+          {
+              expected = nullptr;
+              this_thread::yield();
+          }
+
+          head.store(h + 1, memory_order_release);
+          return true;
+      }
+      /*********************************************************************/
+      // Any thread. Returns nullptr when empty; the caller owns the result.
+      LiveFrame* pop()
+      {
+          uint64_t t = tail.load(memory_order_acquire);
+          while (true)
+          {
+              const uint64_t h = head.load(memory_order_acquire);
+              if (t >= h)
+              {
+                  return nullptr;
+              }
+
+              const uint64_t end = (policy == PROCESS_LATEST) ? h : t + 1;
+              if (tail.compare_exchange_weak(t, end, memory_order_acq_rel))
+              {
+                  for (uint64_t s = t; s + 1 < end; s++)
+                  {
+                      delete take(s);
+                      dropped.fetch_add(1, memory_order_relaxed);
+                  }
+                  return take(end - 1);
+              }
+          }
+      }
+      /*********************************************************************/
+      bool empty() const
+      {
+          return tail.load(memory_order_acquire) >= head.load(memory_order_acquire);
+      }
+      /*********************************************************************/
+      int64_t dropped_count() const
+      {
+          return dropped.load(memory_order_relaxed);
+      }
+};
+
+/*
+ * Fixed-size latency histogram shared by the worker threads: 0.1 ms bins up
+ * to one second, anything slower lands in the last bin (the exact maximum is
+ * kept separately). Memory stays constant however long a live source runs,
+ * and it can be read while workers are still recording.
+ */
+class LatencyHistogram
+{
+  private:
+      static const int bin_count = 10000;
+      static constexpr double bin_ms = 0.1;
+      unique_ptr<atomic<uint64_t>[]> bins;
+      atomic<uint64_t> count;
+      atomic<uint64_t> total_us;
+      atomic<uint64_t> max_us;
+
+  public:
+      /*********************************************************************/
+      LatencyHistogram()
+          : bins(new atomic<uint64_t>[bin_count]), count(0), total_us(0), max_us(0)
+      {
+          reset();
+      }
+      /*********************************************************************/
+      void reset()
+      {
+          for (int i = 0; i < bin_count; i++)
+          {
+              bins[i].store(0, memory_order_relaxed);
+          }
+          count.store(0, memory_order_relaxed);
+          total_us.store(0, memory_order_relaxed);
+          max_us.store(0, memory_order_relaxed);
+      }
+      /*********************************************************************/
+      void record(double ms)
+      {
+          const int bin = min((int)(ms / bin_ms), bin_count - 1);
+          bins[max(bin, 0)].fetch_add(1, memory_order_relaxed);
+
+          const uint64_t us = (uint64_t)max(ms * 1000.0, 0.0);
+          total_us.fetch_add(us, memory_order_relaxed);
+          uint64_t seen = max_us.load(memory_order_relaxed);
+          while (us > seen && !max_us.compare_exchange_weak(seen, us, memory_order_relaxed))
+          {
+          }
+          count.fetch_add(1, memory_order_relaxed);
+      }
+      /*********************************************************************/
+      uint64_t samples() const
+      {
+          return count.load(memory_order_relaxed);
+      }
+      /*********************************************************************/
+      double mean_ms() const
+      {
+          const uint64_t n = samples();
+          return n > 0 ? total_us.load(memory_order_relaxed) / 1000.0 / n : 0;
+      }
+      /*********************************************************************/
+      double max_ms() const
+      {
+          return max_us.load(memory_order_relaxed) / 1000.0;
+      }
+      /*********************************************************************/
+      // Upper edge of the bin holding the p-th fraction of samples.
+      double percentile_ms(double p) const
+      {
+          uint64_t total = 0;
+          for (int i = 0; i < bin_count; i++)
+          {
+              total += bins[i].load(memory_order_relaxed);
+          }
+          if (total == 0)
+          {
+              return 0;
+          }
+
+          const uint64_t rank = (uint64_t)(p * (total - 1)) + 1;
+          uint64_t seen = 0;
+          for (int i = 0; i < bin_count; i++)
+          {
+              seen += bins[i].load(memory_order_relaxed);
+              if (seen >= rank)
+              {
+                  return min((i + 1) * bin_ms, max_ms());
+              }
+          }
+          return max_ms();
+      }
+};
+
+class LiveRoiLoop
+{
+  private:
+      bool verbose;
+      LiveDropPolicy policy;
+      int capacity;
+      int num_workers;
+      atomic<bool> stop_requested;
+      atomic<int64_t> captured;
+      atomic<int64_t> dropped;
+      LatencyHistogram latency;
+
+  public:
+      /*********************************************************************/
+      LiveRoiLoop(LiveDropPolicy policy=PROCESS_LATEST, int capacity=1, int num_workers=1, bool verbose=false)
+          : stop_requested(false), captured(0), dropped(0)
+      {
+          this->verbose = verbose;
+          this->policy = policy;
+          this->capacity = capacity;
+          this->num_workers = max(num_workers, 1);
+      }
+      /*********************************************************************/
+      // Captures on the calling thread until the source ends or stop() is
+      // called from another thread. process is called from the worker
+      // threads with frames in capture order per worker, but frames may be
+      // skipped. With pace_native a file source is throttled to its own frame
+      // rate so it behaves like a camera.
+      LiveStats run(VideoCapture& cap, function<void(const LiveFrame&)> process, bool pace_native=true)
+      {
+          LiveFrameRing ring(policy, capacity);
+          atomic<bool> capture_done(false);
+          mutex wake_mutex;
+          condition_variable wake;
+
+          stop_requested.store(false, memory_order_relaxed);
+          captured.store(0, memory_order_relaxed);
+          dropped.store(0, memory_order_relaxed);
+          latency.reset();
+
+          vector<thread> workers;
+          for (int w = 0; w < num_workers; w++)
+          {
+              workers.emplace_back([&]()
+              {
+                  while (true)
+                  {
+                      LiveFrame* f = ring.pop();
+                      if (f == nullptr)
+                      {
+                          if (capture_done.load(memory_order_acquire) && ring.empty())
+                          {
+                              break;
+                          }
+
+                          unique_lock<mutex> lock(wake_mutex);
+                          wake.wait(lock, [&]()
+                          {
+                              return !ring.empty() || capture_done.load(memory_order_acquire);
+                          });
+                          continue;
+                      }
+
+                      process(*f);
+
+                      chrono::duration<double, milli> lat = chrono::steady_clock::now() - f->captured;
+                      latency.record(lat.count());
+                      delete f;
+                  }
+              });
+          }
+
+          const double fps = cap.get(CAP_PROP_FPS);
+          const bool paced = pace_native && fps > 0;
+          const auto start = chrono::steady_clock::now();
+
+          int64_t seq = 0;
+          while (!stop_requested.load(memory_order_relaxed))
+          {
+              if (paced)
+              {
+                  this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(
+                      chrono::duration<double>(seq / fps)));
+              }
+
+              LiveFrame* f = new LiveFrame();
+              if (!cap.read(f->frame))
+              {
+                  delete f;
+                  break;
+              }
+              f->seq = seq++;
+              f->captured = chrono::steady_clock::now();
+              ring.push(f);
+              captured.store(seq, memory_order_relaxed);
+              dropped.store(ring.dropped_count(), memory_order_relaxed);
+
+              // taking the lock orders the push against a worker that has
+              // just checked the ring and is about to wait, so no wakeup is lost
+              {
+                  lock_guard<mutex> lock(wake_mutex);
+              }
+              wake.notify_one();
+          }
+
+          {
+              lock_guard<mutex> lock(wake_mutex);
+              capture_done.store(true, memory_order_release);
+          }
+          wake.notify_all();
+          for (thread& t : workers)
+          {
+              t.join();
+          }
+          dropped.store(ring.dropped_count(), memory_order_relaxed);
+
+          LiveStats result = stats();
+          if (verbose)
+          {
+              cout << "[DEBUG] Captured " << result.captured << ", processed " << result.processed
+                   << ", dropped " << result.dropped << endl;
+              cout << "[DEBUG] Latency mean " << result.mean_latency_ms << " ms, p50 " << result.p50_latency_ms
+                   << " ms, p95 " << result.p95_latency_ms << " ms, max " << result.max_latency_ms << " ms" << endl;
+          }
+          return result;
+      }
+      /*********************************************************************/
+      // Safe to call from any thread; run() returns once the workers have
+      // drained the frames already queued.
+      void stop()
+      {
+          stop_requested.store(true, memory_order_relaxed);
+      }
+      /*********************************************************************/
+      // Can be polled from another thread while run() is going. Percentiles
+      // have 0.1 ms resolution.
+      LiveStats stats() const
+      {
+          LiveStats s = LiveStats();
+          s.captured = captured.load(memory_order_relaxed);
+          s.processed = latency.samples();
+          s.dropped = dropped.load(memory_order_relaxed);
+          s.mean_latency_ms = latency.mean_ms();
+          s.p50_latency_ms = latency.percentile_ms(0.50);
+          s.p95_latency_ms = latency.percentile_ms(0.95);
+          s.max_latency_ms = latency.max_ms();
+          return s;
+      }
+};
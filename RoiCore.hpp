@@ -0,0 +1,138 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <unordered_map>
+#include <vector>
+#include "Utils.hpp"
+#include "CompiledRoi.hpp"
+
+using namespace cv;
+using namespace std;
+
+/*
+ * GUI-free ROI core: geometry, compile, crop and visualize. Depends only on
+ * opencv_core and opencv_imgproc, so headless workers can include this
+ * header without pulling in HighGUI. The interactive draw_* editor in
+ * EasyRoi.hpp is an optional layer on top: it fills in and returns a
+ * RoiBuilder, so editor and headless crops share the same compiled spans.
+ *
+ * Geometry uses the same per-id layouts as Utils.hpp:
+ *   rectangles {tl_x, tl_y, br_x, br_y}, circles {center_x, center_y, radius},
+ *   polygons and lines as vertex lists.
+ */
+
+class RoiBuilder
+{
+  private:
+      unordered_map<int, vector<int>> rect_roi;
+      unordered_map<int, vector<int>> circle_roi;
+      unordered_map<int, vector<Point>> polygon_roi;
+      unordered_map<int, vector<Point>> line_roi;
+      unordered_map<int, CompiledRoi> compiled;
+
+      /*********************************************************************/
+      void forget(int roi_id)
+      {
+          rect_roi.erase(roi_id);
+          circle_roi.erase(roi_id);
+          polygon_roi.erase(roi_id);
+          line_roi.erase(roi_id);
+          compiled.erase(roi_id);
+      }
+
+  public:
+      /*********************************************************************/
+      // Adding an id that already exists replaces it, whatever its type.
+      RoiBuilder& add_rectangle(int roi_id, int tl_x, int tl_y, int br_x, int br_y)
+      {
+          forget(roi_id);
+          rect_roi[roi_id] = {tl_x, tl_y, br_x, br_y};
+          compiled[roi_id] = compile_rect(tl_x, tl_y, br_x, br_y);
+          return *this;
+      }
+      /*********************************************************************/
+      RoiBuilder& add_circle(int roi_id, Point center, int radius)
+      {
+          forget(roi_id);
+          circle_roi[roi_id] = {center.x, center.y, radius};
+          compiled[roi_id] = compile_circle(center, radius);
+          return *this;
+      }
+      /*********************************************************************/
+      // Vertices are reduced to their convex hull, as the interactive editor does.
+      RoiBuilder& add_polygon(int roi_id, const vector<Point>& vertices)
+      {
+          forget(roi_id);
+
+          vector<Point> hull;
+          convexHull(vertices, hull, false);
+
+          polygon_roi[roi_id] = hull;
+          compiled[roi_id] = compile_polygon(hull);
+          return *this;
+      }
+      /*********************************************************************/
+      // Lines can be visualized but have nothing to crop.
+      RoiBuilder& add_line(int roi_id, Point point1, Point point2)
+      {
+          forget(roi_id);
+          line_roi[roi_id] = {point1, point2};
+          return *this;
+      }
+      /*********************************************************************/
+      void remove(int roi_id)
+      {
+          forget(roi_id);
+      }
+      /*********************************************************************/
+      void clear()
+      {
+          rect_roi.clear();
+          circle_roi.clear();
+          polygon_roi.clear();
+          line_roi.clear();
+          compiled.clear();
+      }
+      /*********************************************************************/
+      const unordered_map<int, vector<int>>& rectangles() const
+      {
+          return rect_roi;
+      }
+      /*********************************************************************/
+      const unordered_map<int, vector<int>>& circles() const
+      {
+          return circle_roi;
+      }
+      /*********************************************************************/
+      const unordered_map<int, vector<Point>>& polygons() const
+      {
+          return polygon_roi;
+      }
+      /*********************************************************************/
+      const unordered_map<int, vector<Point>>& lines() const
+      {
+          return line_roi;
+      }
+      /*********************************************************************/
+      // Rectangles, circles and polygons, rasterised once when they were added.
+      const unordered_map<int, CompiledRoi>& compiled_rois() const
+      {
+          return compiled;
+      }
+      /*********************************************************************/
+      unordered_map<int, Mat> crop(const Mat& frame) const
+      {
+          return crop_compiled(frame, compiled);
+      }
+      /*********************************************************************/
+      Mat visualize(const Mat& frame, const Scalar& color = Scalar(0, 255, 0)) const
+      {
+          Mat img = frame.clone();
+          visualize_rect(img, rect_roi, color);
+          visualize_circle(img, circle_roi, color);
+          visualize_polygon(img, polygon_roi, color);
+          visualize_line(img, line_roi, color);
+          return img;
+      }
+};
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+/*
+ * Per-ROI frame-rate budget scheduler. Each ROI id (the same ids used in
+ * the roi dicts passed to the crop and visualize helpers) carries a
+ * priority and a target rate. Every frame the scheduler picks the ROIs
+ * that are due, highest priority first, until the estimated cost reaches
+ * the per-frame budget.
+ * ROIs that do not fit stay due and are retried on the next frame, so under
+ * load the low-priority ROIs are the ones whose rate degrades. Every frame
+ * an ROI waits raises its effective priority by one, so a low-priority ROI
+ * is delayed but not starved: it eventually outranks the others and they
+ * give up a frame instead.
+ * Cost estimates are never adjusted to make an ROI fit. An ROI whose
+ * estimate alone exceeds the budget is reported as over budget and is only
+ * run as a probe: alone at the head of the frame, at most once per probe
+ * period, and the probe's measurement replaces the old estimate so a cold
+ * first run cannot lock the ROI out. A probe period of 0 disables probes.
+ * The only other unbudgeted run is each ROI's first, which has no estimate.
+ */
+
+struct RoiRate
+{
+    int priority;       // higher runs first
+    double target_fps;  // <= 0 means every frame
+};
+
+struct RoiRateReport
+{
+    int roi_id;
+    int priority;
+    double target_fps;
+    double achieved_fps;
+    int64_t processed;
+    int64_t deferred;   // times the ROI was due but did not fit the budget
+    int64_t probes;     // runs made while the estimate exceeded the budget
+    double cost_ms;     // measured cost, moving average
+    bool over_budget;   // estimate alone exceeds the budget
+};
+
+class RoiScheduler
+{
+  private:
+      struct RoiState
+      {
+          RoiRate rate;
+          double next_due;
+          int64_t processed;
+          int64_t deferred;
+          int64_t probes;
+          int64_t waited;     // consecutive frames deferred
+          double last_run_t;
+          double cost_ms;
+          bool cost_known;
+          bool probing;       // next measurement replaces the estimate
+      };
+
+      bool verbose;
+      double budget_ms;
+      double probe_period;
+      map<int, RoiState> rois;
+      double first_t;
+      double last_t;
+      int64_t frames;
+      bool started;
+
+  public:
+      /*********************************************************************/
+      RoiScheduler(double budget_ms, bool verbose=false)
+      {
+          this->verbose = verbose;
+          this->budget_ms = budget_ms;
+          probe_period = 2.0;
+          first_t = 0;
+          last_t = 0;
+          frames = 0;
+          started = false;
+      }
+      /*********************************************************************/
+      void set_roi(int roi_id, int priority, double target_fps)
+      {
+          RoiState state = RoiState();
+          state.rate = {priority, target_fps};
+          state.next_due = started ? last_t : 0;
+          rois[roi_id] = state;
+      }
+      /*********************************************************************/
+      void remove_roi(int roi_id)
+      {
+          rois.erase(roi_id);
+      }
+      /*********************************************************************/
+      void set_budget(double budget_ms)
+      {
+          this->budget_ms = budget_ms;
+      }
+      /*********************************************************************/
+      // Minimum time in seconds between probe runs of an over-budget ROI.
+      void set_probe_period(double seconds)
+      {
+          probe_period = seconds;
+      }
+      /*********************************************************************/
+      // t is the frame timestamp in seconds (e.g. CAP_PROP_POS_MSEC / 1000).
+      // Returns the ROI ids to process for this frame, highest priority first.
+      vector<int> schedule(double t)
+      {
+          if (!started)
+          {
+              first_t = t;
+              started = true;
+              for (auto& roi : rois)
+              {
+                  roi.second.next_due = t;
+              }
+          }
+          last_t = t;
+          frames++;
+
+          vector<int> due;
+          for (const auto& roi : rois)
+          {
+              if (roi.second.rate.target_fps <= 0 || t >= roi.second.next_due)
+              {
+                  due.push_back(roi.first);
+              }
+          }
+
+          // most important first, aged by the frames spent waiting; among
+          // equals the one that has been due longest
+          sort(due.begin(), due.end(), [&](int a, int b)
+          {
+              const RoiState& ra = rois[a];
+              const RoiState& rb = rois[b];
+              const int64_t pa = ra.rate.priority + ra.waited;
+              const int64_t pb = rb.rate.priority + rb.waited;
+              if (pa != pb)
+              {
+                  return pa > pb;
+              }
+              return ra.next_due < rb.next_due;
+          });
+
+          vector<int> chosen;
+          double spent = 0;
+          for (int id : due)
+          {
+              RoiState& roi = rois[id];
+
+              // an ROI with no cost estimate yet is run once to measure it
+              const double cost = roi.cost_known ? roi.cost_ms : 0;
+              const bool over_budget = cost > budget_ms;
+              const bool probe = over_budget && chosen.empty() && probe_period > 0 &&
+                                 t - roi.last_run_t >= probe_period;
+              if (!probe && spent + cost > budget_ms)
+              {
+                  roi.deferred++;
+                  roi.waited++;
+                  if (verbose)
+                  {
+                      cout << "[DEBUG] ROI " << id << " deferred, " << spent << "/" << budget_ms
+                           << " ms spent, needs " << cost << " ms" << endl;
+                  }
+                  continue;
+              }
+
+              if (probe)
+              {
+                  roi.probes++;
+                  roi.probing = true;
+                  if (verbose)
+                  {
+                      cout << "[DEBUG] ROI " << id << " probed, estimate " << cost << " ms over a "
+                           << budget_ms << " ms budget" << endl;
+                  }
+              }
+
+              chosen.push_back(id);
+              spent += cost;
+              roi.waited = 0;
+              roi.last_run_t = t;
+
+              if (roi.rate.target_fps > 0)
+              {
+                  // keep the phase, but never try to catch up on missed periods
+                  const double period = 1.0 / roi.rate.target_fps;
+                  roi.next_due = (t - roi.next_due > period) ? t + period : roi.next_due + period;
+              }
+          }
+
+          return chosen;
+      }
+      /*********************************************************************/
+      // Feeds the measured cost of one ROI back into its estimate.
+      void report(int roi_id, double cost_ms)
+      {
+          auto it = rois.find(roi_id);
+          if (it == rois.end())
+          {
+              return;
+          }
+
+          RoiState& roi = it->second;
+          roi.cost_ms = (roi.cost_known && !roi.probing) ? 0.8 * roi.cost_ms + 0.2 * cost_ms : cost_ms;
+          roi.cost_known = true;
+          roi.probing = false;
+          roi.processed++;
+      }
+      /*********************************************************************/
+      // schedule() + timing + report() in one call. process is invoked once
+      // per chosen ROI id.
+      vector<int> run(double t, function<void(int)> process)
+      {
+          vector<int> chosen = schedule(t);
+          for (int id : chosen)
+          {
+              const auto start = chrono::steady_clock::now();
+              process(id);
+              chrono::duration<double, milli> cost = chrono::steady_clock::now() - start;
+              report(id, cost.count());
+          }
+          return chosen;
+      }
+      /*********************************************************************/
+      vector<RoiRateReport> rate_report() const
+      {
+          vector<RoiRateReport> result;
+          // N frames span N-1 intervals; add the average period for the last one
+          const double elapsed = frames > 1 ? (last_t - first_t) * frames / (frames - 1) : 0;
+          for (const auto& roi : rois)
+          {
+              RoiRateReport r;
+              r.roi_id = roi.first;
+              r.priority = roi.second.rate.priority;
+              r.target_fps = roi.second.rate.target_fps;
+              r.achieved_fps = elapsed > 0 ? roi.second.processed / elapsed : 0;
+              r.processed = roi.second.processed;
+              r.deferred = roi.second.deferred;
+              r.probes = roi.second.probes;
+              r.cost_ms = roi.second.cost_ms;
+              r.over_budget = roi.second.cost_known && roi.second.cost_ms > budget_ms;
+              result.push_back(r);
+          }
+          return result;
+      }
+      /*********************************************************************/
+      void print_report() const
+      {
+          cout << "ROI  prio  target fps  achieved fps  deferred  probes  cost ms" << endl;
+          for (const RoiRateReport& r : rate_report())
+          {
+              ostringstream target;
+              if (r.target_fps > 0)
+              {
+                  target << fixed << setprecision(2) << r.target_fps;
+              }
+              else
+              {
+                  target << "full";
+              }
+
+              ostringstream row;
+              row << fixed << setprecision(2)
+                  << setw(3) << r.roi_id << "  " << setw(4) << r.priority << "  "
+                  << setw(10) << target.str() << "  " << setw(12) << r.achieved_fps << "  "
+                  << setw(8) << r.deferred << "  " << setw(6) << r.probes << "  " << setw(7) << r.cost_ms;
+              if (r.over_budget)
+              {
+                  row << "  over budget";
+              }
+              cout << row.str() << endl;
+          }
+      }
+};
@@ -0,0 +1,511 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+
+#define ROI_SHM_MAGIC 0x524F4931u
+#define ROI_SHM_MAX_TENSORS 64
+#define ROI_SHM_MAX_DIMS 4
+#define ROI_SHM_ALIGN 64
+
+/*
+ * Single-producer / single-consumer ring of ROI crops in POSIX shared memory.
+ *
+ * Layout: [RoiShmHeader][slot 0][payload 0][slot 1][payload 1]...
+ *
+ * Each slot carries one frame: the ROI ids, the capture timestamp and either
+ * one tensor per ROI (crop mode) or a single tensor whose first dimension
+ * indexes the ROI ids (batch mode). The producer copies each crop straight
+ * out of the frame into the slot; the consumer wraps the slot memory in Mat
+ * headers without copying. head/tail are free-running counters, so the
+ * only synchronisation is one acquire/release pair per side.
+ */
+
+struct RoiShmTensor
+{
+    int32_t type;
+    int32_t dims;
+    int32_t size[ROI_SHM_MAX_DIMS];
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+struct alignas(ROI_SHM_ALIGN) RoiShmSlot
+{
+    int64_t frame_id;
+    int64_t timestamp_ns;
+    uint32_t roi_count;
+    uint32_t tensor_count;
+    int32_t roi_ids[ROI_SHM_MAX_TENSORS];
+    RoiShmTensor tensors[ROI_SHM_MAX_TENSORS];
+};
+
+struct RoiShmHeader
+{
+    atomic<uint32_t> magic;     // set last, once the rest of the header is valid
+    uint32_t slot_count;
+    uint64_t slot_payload;
+    alignas(ROI_SHM_ALIGN) atomic<uint64_t> head;   // next slot to be written
+    alignas(ROI_SHM_ALIGN) atomic<uint64_t> tail;   // next slot to be read
+};
+
+static_assert(atomic<uint64_t>::is_always_lock_free, "ring indices must be lock-free to live in shared memory");
+static_assert(atomic<uint32_t>::is_always_lock_free, "header magic must be lock-free to live in shared memory");
+
+struct RoiShmBatch
+{
+    int64_t frame_id;
+    int64_t timestamp_ns;
+    vector<int> roi_ids;
+    vector<Mat> tensors;    // views into shared memory, valid until release()
+};
+
+/*********************************************************************/
+inline int64_t roi_shm_now_ns()
+{
+    // CLOCK_MONOTONIC is system wide, so producer and consumer stamps compare directly
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+class RoiShmRing
+{
+  private:
+      bool verbose;
+      bool owner;
+      string name;
+      int fd;
+      uint8_t* base;
+      size_t mapped_bytes;
+      RoiShmHeader* header;
+      size_t slot_stride;
+
+      /*********************************************************************/
+      static size_t align_up(size_t n)
+      {
+          return (n + ROI_SHM_ALIGN - 1) & ~(size_t)(ROI_SHM_ALIGN - 1);
+      }
+      /*********************************************************************/
+      RoiShmSlot* slot_at(uint64_t index) const
+      {
+          size_t first = align_up(sizeof(RoiShmHeader));
+          return reinterpret_cast<RoiShmSlot*>(base + first + (index % header->slot_count) * slot_stride);
+      }
+      /*********************************************************************/
+      uint8_t* payload_of(RoiShmSlot* slot) const
+      {
+          return reinterpret_cast<uint8_t*>(slot) + align_up(sizeof(RoiShmSlot));
+      }
+      /*********************************************************************/
+      bool map_region(size_t bytes)
+      {
+          void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+          if (p == MAP_FAILED)
+          {
+              cerr << "[ERROR] mmap failed for " << name << ": " << strerror(errno) << endl;
+              return false;
+          }
+
+          base = static_cast<uint8_t*>(p);
+          mapped_bytes = bytes;
+          header = reinterpret_cast<RoiShmHeader*>(base);
+          return true;
+      }
+      /*********************************************************************/
+      // Claims the next free slot, or returns nullptr when the consumer has
+      // not caught up. Dropping is the producer's call, never blocking.
+      RoiShmSlot* begin_write(int64_t frame_id, int64_t timestamp_ns)
+      {
+          const uint64_t h = header->head.load(memory_order_relaxed);
+          const uint64_t t = header->tail.load(memory_order_acquire);
+          if (h - t >= header->slot_count)
+          {
+              if (verbose)
+              {
+                  cout << "[DEBUG] Ring full, dropping frame " << frame_id << endl;
+              }
+              return nullptr;
+          }
+
+          RoiShmSlot* slot = slot_at(h);
+          slot->frame_id = frame_id;
+          slot->timestamp_ns = timestamp_ns;
+          slot->roi_count = 0;
+          slot->tensor_count = 0;
+          return slot;
+      }
+      /*********************************************************************/
+      bool put_tensor(RoiShmSlot* slot, uint64_t& used, const Mat& src)
+      {
+          if (slot->tensor_count >= ROI_SHM_MAX_TENSORS || src.dims > ROI_SHM_MAX_DIMS || src.empty())
+          {
+              cerr << "[ERROR] Tensor does not fit the shared memory slot layout" << endl;
+              return false;
+          }
+
+          const uint64_t bytes = (uint64_t)src.total() * src.elemSize();
+          if (used + bytes > header->slot_payload)
+          {
+              cerr << "[ERROR] Slot payload of " << header->slot_payload << " bytes too small" << endl;
+              return false;
+          }
+
+          RoiShmTensor& t = slot->tensors[slot->tensor_count++];
+          t.type = src.type();
+          t.dims = src.dims;
+          for (int d = 0; d < src.dims; d++)
+          {
+              t.size[d] = src.size[d];
+          }
+          t.offset = used;
+          t.bytes = bytes;
+
+          // ROI crops are usually strided views into the frame; copyTo packs
+          // them into the slot in one pass without an intermediate buffer
+          Mat dst(src.dims, src.size.p, src.type(), payload_of(slot) + used);
+          src.copyTo(dst);
+
+          used = align_up(used + bytes);
+          return true;
+      }
+      /*********************************************************************/
+      // Counts and extents in a slot are written by another process, so they
+      // are checked before any Mat header is pointed into the payload.
+      bool slot_valid(const RoiShmSlot* slot) const
+      {
+          if (slot->roi_count > ROI_SHM_MAX_TENSORS || slot->tensor_count > ROI_SHM_MAX_TENSORS)
+          {
+              return false;
+          }
+
+          for (uint32_t i = 0; i < slot->tensor_count; i++)
+          {
+              const RoiShmTensor& t = slot->tensors[i];
+              if (t.dims < 1 || t.dims > ROI_SHM_MAX_DIMS)
+              {
+                  return false;
+              }
+
+              uint64_t expected = CV_ELEM_SIZE(t.type);
+              for (int d = 0; d < t.dims; d++)
+              {
+                  if (t.size[d] <= 0)
+                  {
+                      return false;
+                  }
+                  expected *= (uint64_t)t.size[d];
+              }
+
+              if (expected != t.bytes || t.offset > header->slot_payload || t.bytes > header->slot_payload - t.offset)
+              {
+                  return false;
+              }
+          }
+
+          return true;
+      }
+      /*********************************************************************/
+      void commit_write()
+      {
+          const uint64_t h = header->head.load(memory_order_relaxed);
+          header->head.store(h + 1, memory_order_release);
+      }
+
+  public:
+      /*********************************************************************/
+      RoiShmRing(bool verbose=false)
+      {
+          this->verbose = verbose;
+          owner = false;
+          fd = -1;
+          base = nullptr;
+          mapped_bytes = 0;
+          header = nullptr;
+          slot_stride = 0;
+      }
+      /*********************************************************************/
+      ~RoiShmRing()
+      {
+          close();
+      }
+      /*********************************************************************/
+      RoiShmRing(const RoiShmRing&) = delete;
+      RoiShmRing& operator=(const RoiShmRing&) = delete;
+      /*********************************************************************/
+      // Producer side: creates the segment. slot_payload is the byte budget
+      // for all crops of one frame. Fails if the name is already in use, so a
+      // second producer cannot take over a live ring; pass replace_existing
+      // to unlink a segment left behind by a producer that crashed.
+      bool create(const string& name, uint32_t slot_count, uint64_t slot_payload, bool replace_existing=false)
+      {
+          close();
+          this->name = name;
+
+          if (slot_count == 0)
+          {
+              cerr << "[ERROR] " << name << " needs at least one slot" << endl;
+              return false;
+          }
+
+          if (replace_existing)
+          {
+              shm_unlink(name.c_str());
+          }
+          fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+          if (fd < 0)
+          {
+              cerr << "[ERROR] shm_open failed for " << name << ": " << strerror(errno) << endl;
+              if (errno == EEXIST)
+              {
+                  cerr << "[ERROR] Another producer owns " << name << ", or a stale segment was left behind" << endl;
+              }
+              return false;
+          }
+          owner = true;
+
+          slot_stride = align_up(sizeof(RoiShmSlot)) + align_up(slot_payload);
+          const size_t bytes = align_up(sizeof(RoiShmHeader)) + slot_stride * slot_count;
+          if (ftruncate(fd, bytes) != 0)
+          {
+              cerr << "[ERROR] ftruncate failed for " << name << ": " << strerror(errno) << endl;
+              close();
+              return false;
+          }
+
+          if (!map_region(bytes))
+          {
+              close();
+              return false;
+          }
+
+          header->slot_count = slot_count;
+          header->slot_payload = slot_payload;
+          new (&header->head) atomic<uint64_t>(0);
+          new (&header->tail) atomic<uint64_t>(0);
+          header->magic.store(ROI_SHM_MAGIC, memory_order_release);
+
+          if (verbose)
+          {
+              cout << "[DEBUG] Created " << name << " with " << slot_count << " slot(s) of "
+                   << slot_payload << " bytes" << endl;
+          }
+          return true;
+      }
+      /*********************************************************************/
+      // Consumer side: attaches to a segment created by the producer.
+      bool open(const string& name)
+      {
+          close();
+          this->name = name;
+
+          fd = shm_open(name.c_str(), O_RDWR, 0600);
+          if (fd < 0)
+          {
+              if (verbose)
+              {
+                  cout << "[DEBUG] " << name << " not available yet" << endl;
+              }
+              return false;
+          }
+
+          struct stat st;
+          if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RoiShmHeader) || !map_region(st.st_size))
+          {
+              close();
+              return false;
+          }
+
+          if (header->magic.load(memory_order_acquire) != ROI_SHM_MAGIC)
+          {
+              if (verbose)
+              {
+                  cout << "[DEBUG] " << name << " not initialised yet" << endl;
+              }
+              close();
+              return false;
+          }
+
+          // the geometry comes from another process; never index past the mapping
+          slot_stride = align_up(sizeof(RoiShmSlot)) + align_up(header->slot_payload);
+          const size_t needed = align_up(sizeof(RoiShmHeader)) + slot_stride * header->slot_count;
+          if (header->slot_count == 0 || (size_t)st.st_size < needed)
+          {
+              cerr << "[ERROR] " << name << " is " << st.st_size << " bytes, header describes "
+                   << header->slot_count << " slot(s) needing " << needed << endl;
+              close();
+              return false;
+          }
+          return true;
+      }
+      /*********************************************************************/
+      void close()
+      {
+          if (base != nullptr)
+          {
+              munmap(base, mapped_bytes);
+              base = nullptr;
+              header = nullptr;
+          }
+          if (fd >= 0)
+          {
+              ::close(fd);
+              fd = -1;
+          }
+          if (owner)
+          {
+              shm_unlink(name.c_str());
+              owner = false;
+          }
+      }
+      /*********************************************************************/
+      bool is_open() const
+      {
+          return header != nullptr;
+      }
+      /*********************************************************************/
+      // Crop mode: one tensor per ROI. roi_ids[i] names tensors[i]; the order
+      // follows unordered_map iteration and is otherwise unspecified.
+      // Returns false if the ring is full or the crops do not fit; the frame
+      // is then dropped rather than stalling capture.
+      bool write(int64_t frame_id, int64_t timestamp_ns, const unordered_map<int, Mat>& crops)
+      {
+          if (!is_open() || crops.size() > ROI_SHM_MAX_TENSORS)
+          {
+              return false;
+          }
+
+          RoiShmSlot* slot = begin_write(frame_id, timestamp_ns);
+          if (slot == nullptr)
+          {
+              return false;
+          }
+
+          uint64_t used = 0;
+          for (const auto& crop : crops)
+          {
+              slot->roi_ids[slot->roi_count++] = crop.first;
+              if (!put_tensor(slot, used, crop.second))
+              {
+                  return false;
+              }
+          }
+
+          commit_write();
+          return true;
+      }
+      /*********************************************************************/
+      // Batch mode: a single tensor (e.g. from dnn::blobFromImages) whose first
+      // dimension runs over roi_ids.
+      bool write_batch(int64_t frame_id, int64_t timestamp_ns, const vector<int>& roi_ids, const Mat& tensor)
+      {
+          if (!is_open() || roi_ids.size() > ROI_SHM_MAX_TENSORS)
+          {
+              return false;
+          }
+
+          // the consumer maps roi_ids[i] to tensor row i
+          if (tensor.dims < 1 || (size_t)tensor.size[0] != roi_ids.size())
+          {
+              cerr << "[ERROR] Batch tensor has " << (tensor.dims < 1 ? 0 : tensor.size[0])
+                   << " row(s) for " << roi_ids.size() << " ROI id(s)" << endl;
+              return false;
+          }
+
+          RoiShmSlot* slot = begin_write(frame_id, timestamp_ns);
+          if (slot == nullptr)
+          {
+              return false;
+          }
+
+          for (int id : roi_ids)
+          {
+              slot->roi_ids[slot->roi_count++] = id;
+          }
+
+          uint64_t used = 0;
+          if (!put_tensor(slot, used, tensor))
+          {
+              return false;
+          }
+
+          commit_write();
+          return true;
+      }
+      /*********************************************************************/
+      // Maps the oldest unread slot into batch without copying. The slot stays
+      // owned by the consumer until release() is called.
+      bool read(RoiShmBatch& batch)
+      {
+          if (!is_open())
+          {
+              return false;
+          }
+
+          const uint64_t t = header->tail.load(memory_order_relaxed);
+          const uint64_t h = header->head.load(memory_order_acquire);
+          if (t == h)
+          {
+              return false;
+          }
+
+          RoiShmSlot* slot = slot_at(t);
+          uint8_t* payload = payload_of(slot);
+
+          if (!slot_valid(slot))
+          {
+              cerr << "[ERROR] Skipping malformed slot for frame " << slot->frame_id << endl;
+              release();
+              return false;
+          }
+
+          batch.frame_id = slot->frame_id;
+          batch.timestamp_ns = slot->timestamp_ns;
+          batch.roi_ids.assign(slot->roi_ids, slot->roi_ids + slot->roi_count);
+          batch.tensors.clear();
+          for (uint32_t i = 0; i < slot->tensor_count; i++)
+          {
+              const RoiShmTensor& tensor = slot->tensors[i];
+              batch.tensors.push_back(Mat(tensor.dims, tensor.size, tensor.type, payload + tensor.offset));
+          }
+
+          return true;
+      }
+      /*********************************************************************/
+      void release()
+      {
+          if (!is_open())
+          {
+              return;
+          }
+
+          const uint64_t t = header->tail.load(memory_order_relaxed);
+          header->tail.store(t + 1, memory_order_release);
+      }
+      /*********************************************************************/
+      uint64_t pending() const
+      {
+          if (!is_open())
+          {
+              return 0;
+          }
+
+          return header->head.load(memory_order_acquire) - header->tail.load(memory_order_acquire);
+      }
+};
@@ -0,0 +1,59 @@
+#include <opencv2/opencv.hpp>
+#include <opencv2/videoio.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Utils.hpp"
+#include "RoiScheduler.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Three entry lanes at full rate and a parking polygon at 1 fps, scheduled
+// under a per-frame budget. Usage: SchedulerDemo [budget_ms]
+
+int main(int argc, char** argv)
+{
+    string video_path = "overpass.mp4";
+    const double budget_ms = argc > 1 ? stod(argv[1]) : 5.0;
+
+    VideoCapture cap(video_path);
+    if (!cap.isOpened())
+    {
+        cerr << "Cannot capture source" << endl;
+        return -1;
+    }
+
+    const int w = (int)cap.get(CAP_PROP_FRAME_WIDTH);
+    const int h = (int)cap.get(CAP_PROP_FRAME_HEIGHT);
+
+    unordered_map<int, vector<Point>> polygon_roi;
+    for (int i = 0; i < 3; i++)
+    {
+        polygon_roi[i] = {Point(i * w / 3, h / 2), Point((i + 1) * w / 3 - 1, h / 2),
+                          Point((i + 1) * w / 3 - 1, h - 1), Point(i * w / 3, h - 1)};
+    }
+    polygon_roi[3] = {Point(0, 0), Point(w - 1, 0), Point(w - 1, h / 2 - 1), Point(0, h / 2 - 1)};
+
+    RoiScheduler scheduler(budget_ms);
+    scheduler.set_roi(0, 10, 0);
+    scheduler.set_roi(1, 10, 0);
+    scheduler.set_roi(2, 10, 0);
+    scheduler.set_roi(3, 1, 1.0);
+
+    Mat frame;
+    while (cap.read(frame))
+    {
+        const double t = cap.get(CAP_PROP_POS_MSEC) / 1000.0;
+        scheduler.run(t, [&](int roi_id)
+        {
+            unordered_map<int, vector<Point>> one = {{roi_id, polygon_roi[roi_id]}};
+            unordered_map<int, Mat> crops = crop_polygon(frame, one);
+        });
+    }
+
+    cout << "Budget " << budget_ms << " ms per frame" << endl;
+    scheduler.print_report();
+
+    return 0;
+}
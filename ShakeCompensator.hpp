@@ -0,0 +1,389 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <opencv2/calib3d.hpp>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "CompiledRoi.hpp"
+
+using namespace cv;
+using namespace std;
+
+/*
+ * Camera-shake compensation without warping frames. ShakeCompensator tracks
+ * a sparse feature set with pyramidal LK and fits a similarity transform
+ * from the reference frame (the one the ROIs were drawn on) to the current
+ * frame. ShakeRoiSet then moves only the ROI vertices and circle centers by
+ * that transform and recompiles an ROI's spans only when its rasterised
+ * shape actually changed; a whole-pixel shift just moves the bounding box.
+ * Every feature keeps the position it was registered at in the reference
+ * frame, and features found later are registered against the stored
+ * reference image rather than through the current estimate, so the
+ * transform is always fitted reference -> frame and never inherits its own
+ * past errors. Individual tracks can still wander; RANSAC drops those.
+ */
+
+class ShakeCompensator
+{
+  private:
+      bool verbose;
+      int max_features;
+      Mat ref_gray;
+      Mat prev_gray;
+      vector<Point2f> ref_pts;    // feature positions in reference coordinates
+      vector<Point2f> cur_pts;    // the same features in the previous frame
+      Mat transform;              // 2x3 CV_64F, reference -> current
+
+      /*********************************************************************/
+      void to_gray(const Mat& frame, Mat& gray) const
+      {
+          if (frame.channels() == 1)
+          {
+              // capture buffers are reused, and the previous frame is kept
+              gray = frame.clone();
+          }
+          else
+          {
+              cvtColor(frame, gray, COLOR_BGR2GRAY);
+          }
+      }
+      /*********************************************************************/
+      // Adds features from the current frame away from the ones still
+      // tracked, which are kept as they are. Each new point is located in
+      // the reference image with LK, seeded by the inverse of the current
+      // estimate, and dropped if the two disagree by more than the RANSAC
+      // threshold.
+      void detect_features(const Mat& gray)
+      {
+          const int wanted = max_features - (int)cur_pts.size();
+          if (wanted <= 0)
+          {
+              return;
+          }
+
+          Mat mask(gray.size(), CV_8UC1, Scalar(255));
+          for (const Point2f& p : cur_pts)
+          {
+              circle(mask, p, 10, Scalar(0), -1);
+          }
+
+          vector<Point2f> fresh;
+          goodFeaturesToTrack(gray, fresh, wanted, 0.01, 10, mask);
+          if (fresh.empty())
+          {
+              return;
+          }
+
+          Mat inverse;
+          invertAffineTransform(transform, inverse);
+          vector<Point2f> predicted;
+          cv::transform(fresh, predicted, inverse);
+
+          vector<Point2f> found = predicted;
+          vector<uchar> status;
+          vector<float> err;
+          calcOpticalFlowPyrLK(gray, ref_gray, fresh, found, status, err, Size(21, 21), 3,
+                               TermCriteria(TermCriteria::COUNT | TermCriteria::EPS, 30, 0.01),
+                               OPTFLOW_USE_INITIAL_FLOW);
+
+          for (size_t i = 0; i < fresh.size(); i++)
+          {
+              if (status[i] && norm(found[i] - predicted[i]) <= 3.0)
+              {
+                  cur_pts.push_back(fresh[i]);
+                  ref_pts.push_back(found[i]);
+              }
+          }
+
+          if (verbose)
+          {
+              cout << "[DEBUG] Tracking " << cur_pts.size() << " feature(s)" << endl;
+          }
+      }
+
+  public:
+      /*********************************************************************/
+      ShakeCompensator(int max_features=200, bool verbose=false)
+      {
+          this->verbose = verbose;
+          this->max_features = max_features;
+          transform = Mat::eye(2, 3, CV_64F);
+      }
+      /*********************************************************************/
+      // The frame the ROIs were drawn on.
+      void set_reference(const Mat& frame)
+      {
+          transform = Mat::eye(2, 3, CV_64F);
+          to_gray(frame, ref_gray);
+          prev_gray = ref_gray;
+
+          goodFeaturesToTrack(ref_gray, cur_pts, max_features, 0.01, 10);
+          ref_pts = cur_pts;
+      }
+      /*********************************************************************/
+      // Returns the reference -> frame transform. Falls back to the last good
+      // estimate when too few features survive.
+      Mat update(const Mat& frame)
+      {
+          Mat gray;
+          to_gray(frame, gray);
+
+          if (prev_gray.empty())
+          {
+              set_reference(frame);
+              return transform.clone();
+          }
+
+          if (!cur_pts.empty())
+          {
+              vector<Point2f> next_pts;
+              vector<uchar> status;
+              vector<float> err;
+              calcOpticalFlowPyrLK(prev_gray, gray, cur_pts, next_pts, status, err);
+
+              vector<Point2f> good_ref, good_next;
+              for (size_t i = 0; i < status.size(); i++)
+              {
+                  if (status[i])
+                  {
+                      good_ref.push_back(ref_pts[i]);
+                      good_next.push_back(next_pts[i]);
+                  }
+              }
+
+              // fit against the reference positions rather than chaining
+              // frame-to-frame estimates; tracks that have wandered are outliers
+              vector<uchar> inliers;
+              Mat estimate;
+              if (good_ref.size() >= 6)
+              {
+                  estimate = estimateAffinePartial2D(good_ref, good_next, inliers, RANSAC, 3.0);
+              }
+
+              if (!estimate.empty())
+              {
+                  transform = estimate;
+                  ref_pts.clear();
+                  cur_pts.clear();
+                  for (size_t i = 0; i < inliers.size(); i++)
+                  {
+                      if (inliers[i])
+                      {
+                          ref_pts.push_back(good_ref[i]);
+                          cur_pts.push_back(good_next[i]);
+                      }
+                  }
+              }
+              else
+              {
+                  ref_pts = good_ref;
+                  cur_pts = good_next;
+              }
+          }
+
+          if ((int)cur_pts.size() < max_features / 2)
+          {
+              detect_features(gray);
+          }
+
+          prev_gray = gray;
+          return transform.clone();
+      }
+      /*********************************************************************/
+      Mat current_transform() const
+      {
+          return transform.clone();
+      }
+};
+
+class ShakeRoiSet
+{
+  private:
+      struct TrackedRoi
+      {
+          bool is_circle;
+          vector<Point2f> base;     // reference vertices, or the circle center
+          float base_radius;
+          vector<Point> placed;     // rounded geometry the spans were built for
+          int placed_radius;
+          CompiledRoi compiled;
+      };
+
+      unordered_map<int, TrackedRoi> rois;
+      int recompiled;
+      int translated;
+
+      /*********************************************************************/
+      static CompiledRoi compile_tracked(const TrackedRoi& roi)
+      {
+          if (roi.is_circle)
+          {
+              return compile_circle(roi.placed[0], roi.placed_radius);
+          }
+          return compile_polygon(roi.placed);
+      }
+      /*********************************************************************/
+      void place(TrackedRoi& roi, const Mat& m, bool force)
+      {
+          vector<Point2f> moved;
+          cv::transform(roi.base, moved, m);
+
+          vector<Point> placed;
+          for (const Point2f& p : moved)
+          {
+              placed.push_back(Point(cvRound(p.x), cvRound(p.y)));
+          }
+
+          // similarity transform: radius scales with sqrt of the determinant
+          const double scale = sqrt(fabs(m.at<double>(0, 0) * m.at<double>(1, 1) - m.at<double>(0, 1) * m.at<double>(1, 0)));
+          const int radius = cvRound(roi.base_radius * scale);
+
+          if (!force && radius == roi.placed_radius)
+          {
+              // same shape shifted by whole pixels: keep the spans
+              const Point offset = placed[0] - roi.placed[0];
+              bool rigid = true;
+              for (size_t i = 1; i < placed.size() && rigid; i++)
+              {
+                  rigid = placed[i] - roi.placed[i] == offset;
+              }
+
+              if (rigid)
+              {
+                  if (offset != Point(0, 0))
+                  {
+                      translate_compiled(roi.compiled, offset);
+                      roi.placed = placed;
+                      translated++;
+                  }
+                  return;
+              }
+          }
+
+          roi.placed = placed;
+          roi.placed_radius = radius;
+          roi.compiled = compile_tracked(roi);
+          recompiled++;
+      }
+
+  public:
+      /*********************************************************************/
+      ShakeRoiSet()
+      {
+          recompiled = 0;
+          translated = 0;
+      }
+      /*********************************************************************/
+      // {tl_x, tl_y, br_x, br_y} per id, as used by crop_rect
+      void add_rectangles(const unordered_map<int, vector<int>>& roi_dict)
+      {
+          for (const auto& roi : roi_dict)
+          {
+              const float tl_x = roi.second[0], tl_y = roi.second[1];
+              const float br_x = roi.second[2] - 1, br_y = roi.second[3] - 1;
+              add_polygon(roi.first, {Point2f(tl_x, tl_y), Point2f(br_x, tl_y), Point2f(br_x, br_y), Point2f(tl_x, br_y)});
+          }
+      }
+      /*********************************************************************/
+      // {center_x, center_y, radius} per id, as used by crop_circle
+      void add_circles(const unordered_map<int, vector<int>>& roi_dict)
+      {
+          for (const auto& roi : roi_dict)
+          {
+              TrackedRoi t;
+              t.is_circle = true;
+              t.base = {Point2f(roi.second[0], roi.second[1])};
+              t.base_radius = roi.second[2];
+              t.placed_radius = 0;
+              place(t, Mat::eye(2, 3, CV_64F), true);
+              rois[roi.first] = t;
+          }
+      }
+      /*********************************************************************/
+      void add_polygons(const unordered_map<int, vector<Point>>& roi_dict)
+      {
+          for (const auto& roi : roi_dict)
+          {
+              vector<Point2f> vertices(roi.second.begin(), roi.second.end());
+              add_polygon(roi.first, vertices);
+          }
+      }
+      /*********************************************************************/
+      void add_polygon(int roi_id, const vector<Point2f>& vertices)
+      {
+          TrackedRoi t;
+          t.is_circle = false;
+          t.base = vertices;
+          t.base_radius = 0;
+          t.placed_radius = 0;
+          place(t, Mat::eye(2, 3, CV_64F), true);
+          rois[roi_id] = t;
+      }
+      /*********************************************************************/
+      // m is the reference -> frame transform from ShakeCompensator::update
+      void update(const Mat& m)
+      {
+          for (auto& roi : rois)
+          {
+              place(roi.second, m, false);
+          }
+      }
+      /*********************************************************************/
+      unordered_map<int, Mat> crop(const Mat& img) const
+      {
+          unordered_map<int, Mat> cropped_images;
+          for (const auto& roi : rois)
+          {
+              cropped_images[roi.first] = crop_compiled(img, roi.second.compiled);
+          }
+          return cropped_images;
+      }
+      /*********************************************************************/
+      // Current geometry in the layout visualize_polygon/visualize_circle take.
+      unordered_map<int, vector<Point>> polygons() const
+      {
+          unordered_map<int, vector<Point>> result;
+          for (const auto& roi : rois)
+          {
+              if (!roi.second.is_circle)
+              {
+                  result[roi.first] = roi.second.placed;
+              }
+          }
+          return result;
+      }
+      /*********************************************************************/
+      unordered_map<int, vector<int>> circles() const
+      {
+          unordered_map<int, vector<int>> result;
+          for (const auto& roi : rois)
+          {
+              if (roi.second.is_circle)
+              {
+                  const Point c = roi.second.placed[0];
+                  result[roi.first] = {c.x, c.y, roi.second.placed_radius};
+              }
+          }
+          return result;
+      }
+      /*********************************************************************/
+      // Spans the crops are taken with, in current-frame coordinates.
+      unordered_map<int, CompiledRoi> compiled_rois() const
+      {
+          unordered_map<int, CompiledRoi> result;
+          for (const auto& roi : rois)
+          {
+              result[roi.first] = roi.second.compiled;
+          }
+          return result;
+      }
+      /*********************************************************************/
+      void print_stats() const
+      {
+          cout << "ROI updates: " << translated << " translated, " << recompiled << " recompiled" << endl;
+      }
+};
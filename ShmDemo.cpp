@@ -0,0 +1,142 @@
+#include <opencv2/opencv.hpp>
+#include <opencv2/videoio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Utils.hpp"
+#include "RoiShm.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Run "ShmDemo producer" and "ShmDemo consumer" in two terminals. The
+// producer crops fixed rectangles out of overpass.mp4 into shared memory;
+// the consumer reads them in place and reports capture-to-consume latency.
+
+static const string shm_name = "/easyroi_crops";
+
+/*********************************************************************/
+int run_producer()
+{
+    VideoCapture cap("overpass.mp4");
+    if (!cap.isOpened())
+    {
+        cerr << "Cannot capture source" << endl;
+        return -1;
+    }
+
+    RoiShmRing ring(true);
+    if (!ring.create(shm_name, 8, 4 << 20))
+    {
+        return -1;
+    }
+
+    // three lanes across the middle band of the frame, no GUI needed
+    const int w = (int)cap.get(CAP_PROP_FRAME_WIDTH);
+    const int h = (int)cap.get(CAP_PROP_FRAME_HEIGHT);
+    unordered_map<int, vector<int>> rect_roi;
+    for (int i = 0; i < 3; i++)
+    {
+        rect_roi[i] = {i * w / 3, h / 3, (i + 1) * w / 3, 2 * h / 3};
+    }
+
+    Mat frame;
+    int64_t frame_id = 0;
+    int dropped = 0;
+    while (cap.read(frame))
+    {
+        const int64_t captured = roi_shm_now_ns();
+        unordered_map<int, Mat> crops = crop_rect(frame, rect_roi);
+        if (!ring.write(frame_id, captured, crops))
+        {
+            dropped++;
+        }
+        frame_id++;
+    }
+
+    cout << "Produced " << frame_id << " frame(s), dropped " << dropped << endl;
+
+    // give a consumer time to drain before the segment is unlinked, but do
+    // not wait forever if none is attached or it already timed out
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (ring.pending() > 0 && chrono::steady_clock::now() < deadline)
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    if (ring.pending() > 0)
+    {
+        cout << ring.pending() << " frame(s) left unread" << endl;
+    }
+    return 0;
+}
+/*********************************************************************/
+int run_consumer()
+{
+    RoiShmRing ring;
+    while (!ring.open(shm_name))
+    {
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+
+    vector<double> latency_us;
+    double checksum = 0;
+    RoiShmBatch batch;
+    auto idle_since = chrono::steady_clock::now();
+    while (chrono::steady_clock::now() - idle_since < chrono::seconds(2))
+    {
+        if (!ring.read(batch))
+        {
+            this_thread::yield();
+            continue;
+        }
+
+        // touch the crops the way an inference step would, then stamp
+        for (const Mat& tensor : batch.tensors)
+        {
+            checksum += sum(tensor)[0];
+        }
+        latency_us.push_back((roi_shm_now_ns() - batch.timestamp_ns) / 1000.0);
+
+        ring.release();
+        idle_since = chrono::steady_clock::now();
+    }
+
+    if (latency_us.empty())
+    {
+        cout << "No frames received" << endl;
+        return 0;
+    }
+
+    sort(latency_us.begin(), latency_us.end());
+    double mean = 0;
+    for (double l : latency_us)
+    {
+        mean += l;
+    }
+    mean /= latency_us.size();
+
+    cout << "Consumed " << latency_us.size() << " frame(s), checksum " << checksum << endl;
+    cout << "Latency mean " << mean << " us, p50 " << latency_us[latency_us.size() / 2]
+         << " us, p99 " << latency_us[latency_us.size() * 99 / 100]
+         << " us, max " << latency_us.back() << " us" << endl;
+    return 0;
+}
+/*********************************************************************/
+int main(int argc, char** argv)
+{
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "producer")
+    {
+        return run_producer();
+    }
+    if (mode == "consumer")
+    {
+        return run_consumer();
+    }
+
+    cerr << "Usage: " << argv[0] << " producer|consumer" << endl;
+    return -1;
+}
@@ -1,12 +1,14 @@
+#pragma once
 
-#include <opencv2/opencv.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
 #include <vector>
 #include <unordered_map>
 
 using namespace cv;
 using namespace std;
 
-Mat visualize_rect(Mat img, const unordered_map<int, vector<int>>& roi_dict, const Scalar& color = Scalar(0, 255, 0)) 
+inline Mat visualize_rect(Mat img, const unordered_map<int, vector<int>>& roi_dict, const Scalar& color = Scalar(0, 255, 0)) 
 {
     for (const auto& roi : roi_dict) 
     {
@@ -21,7 +23,7 @@ Mat visualize_rect(Mat img, const unordered_map<int, vector<int>>& roi_dict, con
     return img;
 }
 
-Mat visualize_line(Mat img, const unordered_map<int, vector<Point>>& roi_dict, const Scalar& color = Scalar(0, 255, 0)) 
+inline Mat visualize_line(Mat img, const unordered_map<int, vector<Point>>& roi_dict, const Scalar& color = Scalar(0, 255, 0)) 
 {
     for (const auto& roi : roi_dict) 
     {
@@ -34,7 +36,7 @@ Mat visualize_line(Mat img, const unordered_map<int, vector<Point>>& roi_dict, c
     return img;
 }
 
-Mat visualize_circle(Mat img, const unordered_map<int, vector<int>>& roi_dict, const Scalar& color = Scalar(0, 255, 0)) 
+inline Mat visualize_circle(Mat img, const unordered_map<int, vector<int>>& roi_dict, const Scalar& color = Scalar(0, 255, 0)) 
 {
     for (const auto& roi : roi_dict) 
     {
@@ -47,7 +49,7 @@ Mat visualize_circle(Mat img, const unordered_map<int, vector<int>>& roi_dict, c
     return img;
 }
 
-Mat visualize_polygon(Mat img, const unordered_map<int, vector<Point>>& roi_dict, const Scalar& color = Scalar(0, 255, 0)) 
+inline Mat visualize_polygon(Mat img, const unordered_map<int, vector<Point>>& roi_dict, const Scalar& color = Scalar(0, 255, 0)) 
 {
     for (const auto& roi : roi_dict) 
     {
@@ -64,7 +66,7 @@ Mat visualize_polygon(Mat img, const unordered_map<int, vector<Point>>& roi_dict
     return img;
 }
 
-unordered_map<int, Mat> crop_rect(const Mat& img, const unordered_map<int, vector<int>>& roi_dict) 
+inline unordered_map<int, Mat> crop_rect(const Mat& img, const unordered_map<int, vector<int>>& roi_dict) 
 {
     unordered_map<int, Mat> cropped_images;
 
@@ -81,7 +83,7 @@ unordered_map<int, Mat> crop_rect(const Mat& img, const unordered_map<int, vecto
     return cropped_images;
 }
 
-unordered_map<int, Mat> crop_circle(const Mat& img, const unordered_map<int, vector<int>>& roi_dict) 
+inline unordered_map<int, Mat> crop_circle(const Mat& img, const unordered_map<int, vector<int>>& roi_dict) 
 {
     unordered_map<int, Mat> cropped_images;
 
@@ -103,7 +105,7 @@ unordered_map<int, Mat> crop_circle(const Mat& img, const unordered_map<int, vec
     return cropped_images;
 }
 
-unordered_map<int, Mat> crop_polygon(const Mat& img, const unordered_map<int, vector<Point>>& roi_dict) 
+inline unordered_map<int, Mat> crop_polygon(const Mat& img, const unordered_map<int, vector<Point>>& roi_dict) 
 {
     unordered_map<int, Mat> cropped_images;
 